@@ -1,31 +1,112 @@
 #ifndef BUF_H
 #define BUF_H
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
 #include "db.h"
+#include "bufRepl.h"
+#include "bufIO.h"
 // define if debug output wanted
 //#define DEBUGBUF
 
-// declarations for buffer pool hash table
+// the buffer pool is one region aligned for direct I/O, and to (and
+// backed by) huge pages of this size
+const unsigned long HUGEPAGESIZE = 2 * 1024 * 1024;
+
+// address space set aside for the buffer pool, which bounds how far
+// it can grow; only the part in use is backed by memory
+const unsigned long MAXPOOLBYTES = 1UL << 34;
+
+const int MINBUFS = 16;  // fewest frames a pool may have
+
+// number of frames that fit in a memory budget such as "64M", "2G"
+// or "512K" (a plain number is bytes), at least MINBUFS; returns -1
+// if budget is not a size
+int bufsForBudget(const char* budget);
+
+// Files are assigned to a buffer pool by kind when they are opened
+// (see DB::openFile()), so that a big sort cannot push the catalogs
+// or a join's build side out of memory.  A kind without a pool of its
+// own uses bufMgr.
+enum PoolKind { CATALOGPOOL, BASEPOOL, TEMPPOOL };
+const int NUMPOOLS = 3;
+
+class BufMgr;
+extern BufMgr* bufPools[NUMPOOLS];
+
+const char* poolKindName(const PoolKind kind);
+
+// declarations for buffer pool hash table.  A slot of the table;
+// file == NULL marks an empty slot.
 struct hashBucket
 {
-	File*	file;    // pointer a file object (more on this below)
+	const File*	file;    // pointer a file object (more on this below)
 	int	pageNo;  // page number within a file
 	int	frameNo; // frame number of page in the buffer pool
-	hashBucket* 	next;	 // next node in the hash table
+};
+
+// one independently latched part of the hash table: an open-addressing
+// (linear probing) array of 2^k slots
+struct hashPart
+{
+	hashBucket*	slots;
+	unsigned int	mask;	// number of slots - 1
+	int		count;	// slots in use
 };
 
 
-// hash table to keep track of pages in the buffer pool
+// number of parts (and latches) the hash table is split into
+const int HTSTRIPES = 16;
+
+// hash table to keep track of pages in the buffer pool.  The table is
+// split into HTSTRIPES parts by the high bits of the hash; each part
+// is a flat linear-probing table, so lookups touch a few adjacent
+// slots and inserts allocate nothing (a part only reallocates when it
+// grows past 3/4 full).  Deletes shift the following entries back
+// instead of leaving tombstones.
+//
+// The table does no locking of its own: callers hold
+// latchFor(file,pageNo) around insert, lookup and remove of that page.
 class BufHashTbl
 {
 private:
-    int HTSIZE;
-    hashBucket**  ht; // actual hash table
-    int	 hash(const File* file, const int pageNo); // returns value between 0 and HTSIZE-1
+    hashPart	parts[HTSTRIPES];
+    mutex	latches[HTSTRIPES];  // latches[i] protects parts[i]
+
+    // mixes the bits of (file,pageNo) into a 64 bit hash value
+    static unsigned long hash(const File* file, const int pageNo);
+    static int partOf(const unsigned long h)
+    {
+	return (int) ((h >> 32) % HTSTRIPES);
+    }
+    void grow(hashPart & part);  // double the number of slots of part
+    // move the entries of part to a new array of size slots
+    void rehash(hashPart & part, const unsigned int size);
+    // initial number of slots per part for htSize entries
+    static unsigned int partSize(const int htSize);
 
 public:
-    BufHashTbl(const int htSize);  // constructor
+    BufHashTbl(const int htSize);  // constructor, htSize entries expected
     ~BufHashTbl(); // destructor
+
+    // latch protecting the entry of (file,pageNo)
+  mutex & latchFor(const File* file, const int pageNo)
+  {
+      return latches[partOf(hash(file, pageNo))];
+  }
+
+    // latch of part i; resizing takes all of them, in order
+  mutex & partLatch(const int i)
+  {
+      return latches[i];
+  }
+
+    // resize every part as the constructor would for htSize entries
+    // (never below what the entries need).  Caller holds all latches.
+  void resize(const int htSize);
 	
     // insert entry into hash table mapping (file,pageNo) to frameNo;
     // returns 0 if OK, HASHTBLERROR if an error occurred
@@ -43,18 +124,37 @@ public:
 
 
 class BufMgr;  //forward declaration of BufMgr class 
+struct PageIOReq;     // a batched page read or write, see pageIO.h
+struct PendingWrite;  // a page waiting to be written, see buf.C
+struct ChainState;    // progress of a read-ahead request, see buf.C
 
-// class for maintaining information about buffer pool frames
+// class for maintaining information about buffer pool frames.
+// file and pageNo only change under the buffer manager's allocation
+// latch; dirty is changed under the page's hash table latch.  The
+// pin count and the flags are atomic so that readers can pin a
+// resident page, and the clock and the background writer can sweep,
+// without taking those latches.
 class BufDesc {
     friend class BufMgr;
+    friend class BufReplacer;
 private:
   File* file;   // pointer to file object
   int   pageNo; // page within file
   int	frameNo;  // frame # of frame
-  int   pinCnt; // number of times this page has been pinned
-  bool 	dirty;	  // true if dirty;  false otherwise
-  bool 	valid;   // true if page is valid
-  bool  refbit;	 // has this buffer frame been reference recently
+  atomic<int>  pinCnt;  // number of times this page has been pinned
+  atomic<bool> dirty;   // true if dirty;  false otherwise
+  atomic<bool> valid;   // true if page is valid
+  atomic<bool> refbit;  // has this buffer frame been reference recently
+  atomic<bool> loading; // page is still being read in from disk
+  atomic<bool> prefetched; // read ahead and not requested since
+  atomic<LSN>  pageLSN; // last logged change to the page, 0 if none
+  atomic<int>  imaged;  // log file the whole page was last logged in
+                        // since it came in, 0 if none (see WAL)
+  atomic<unsigned long long> version; // stamp from clock, renewed
+                                      // whenever the page comes in
+                                      // or is changed
+
+  static atomic<unsigned long long> clock; // source of version stamps
 
   void Clear() {  // initialize buffer frame for a new user
     	pinCnt = 0;
@@ -62,32 +162,156 @@ private:
 	pageNo = -1;
     	dirty = false;
 	valid = false;
+	loading = false;
+	prefetched = false;
+	pageLSN = 0;
+	imaged = 0;
   };
 
-  void Set(File* filePtr, int pageNum) { 
+  void Set(File* filePtr, int pageNum, bool reading = false) { 
       file = filePtr;
       pageNo = pageNum;
       pinCnt = 1;
       dirty = false;
       valid = true;
       refbit = true;
+      loading = reading;
+      prefetched = false;
+      pageLSN = 0;
+      imaged = 0;
+      version = ++clock;
   }
 
   BufDesc() {
       Clear();
+      refbit = false;
+  }
+};
+
+
+// A pin on a page in the buffer pool, handed out by the readPage()
+// and allocPage() overloads that take one.  The handle remembers the
+// frame, so unpinning needs no hash table lookup, and whether the
+// page was changed.  The pin is released by release() or when the
+// handle goes out of scope; handles can be moved but not copied.
+//
+// Changes to the page are made between beginChange() and endChange(),
+// which logs them if the page's file is logged (see WAL).
+class PageHandle {
+    friend class BufMgr;
+private:
+  BufMgr* mgr;  // pool the page is pinned in, NULL if none
+  int   frame;  // frame holding the page
+  Page* page;   // the page, NULL if nothing is pinned
+  bool  dirty;  // page was changed while pinned
+  File* mapped; // file whose read-only mapping holds the page, NULL if
+                // the page is in a frame
+  Page* before; // copy of the page taken by beginChange(), NULL if none
+                // was needed yet; kept for the next change
+  bool  changing; // a change to be logged is under way
+
+  void take(PageHandle & other) {
+      mgr = other.mgr;
+      frame = other.frame;
+      page = other.page;
+      dirty = other.dirty;
+      mapped = other.mapped;
+      changing = other.changing;
+      swap(before, other.before);
+      other.mgr = NULL;
+      other.page = NULL;
+      other.dirty = false;
+      other.mapped = NULL;
+      other.changing = false;
   }
+
+public:
+  PageHandle() : mgr(NULL), frame(-1), page(NULL), dirty(false),
+                 mapped(NULL), before(NULL), changing(false) {}
+  PageHandle(PageHandle && other) : before(NULL) { take(other); }
+  PageHandle & operator = (PageHandle && other) {
+      if (this != &other) {
+          release();
+          take(other);
+      }
+      return *this;
+  }
+  PageHandle(const PageHandle &) = delete;
+  PageHandle & operator = (const PageHandle &) = delete;
+  ~PageHandle() { release(); delete before; }
+
+  Page* get() const { return page; }
+  Page* operator -> () const { return page; }
+  bool  pinned() const { return page != NULL; }
+  // the page is read in place from a mapped file and must not be
+  // changed
+  bool  inMapping() const { return mapped != NULL; }
+
+  // the page will be written back when it is evicted
+  void  setDirty() { dirty = true; }
+
+  // the page is about to be changed
+  void  beginChange();
+  // the change is made: log it (the whole page, without a
+  // beginChange()) and mark the page dirty
+  void  endChange();
+
+  // a stamp that differs whenever the page may have changed since it
+  // was last taken, through this handle or any other; 0 for a page
+  // read in place from a mapping
+  unsigned long long version() const;
+
+  // unpin the page now; OK if nothing was pinned
+  const Status release();
+};
+
+
+// A small private ring of frames for large sequential scans and bulk
+// inserts.  Pages read or allocated through a ring recycle the ring's
+// own frames instead of pushing the rest of the pool (catalog pages,
+// the build side of a join) out of the buffer pool.
+const int BULKRINGSIZE = 8;  // frames in a bulk access ring
+
+class BufRing {
+    friend class BufMgr;
+private:
+  int   size;              // number of slots
+  int   next;              // slot to recycle next
+  vector<int> frames;      // frame held by each slot, -1 if none yet
+  vector<BufPageKey> keys; // page the ring put into each frame
+
+public:
+  BufRing(const int ringSize = BULKRINGSIZE)
+    : size(ringSize), next(0), frames(ringSize, -1), keys(ringSize) {}
 };
 
 
 struct BufStats
 {
-  int accesses;    // Total number of accesses to buffer pool
-  int diskreads;   // Number of pages read from disk (including allocs)
-  int diskwrites;  // Number of pages written back to disk
+  atomic<int> accesses;    // Total number of accesses to buffer pool
+  atomic<int> hits;        // Number of accesses satisfied without disk I/O
+  atomic<int> diskreads;   // Number of pages read from disk (including allocs)
+  atomic<int> diskwrites;  // Number of pages written back to disk
+  atomic<int> ringreuses;  // Number of frames recycled by bulk access rings
+  atomic<int> prefetches;  // Number of pages read ahead (included in diskreads)
+  atomic<int> prefetchhits;   // Number of read-ahead pages requested later
+  atomic<int> prefetchwasted; // Number of read-ahead pages evicted unused
+  atomic<int> bgwrites;    // Number of pages written ahead of eviction by the
+                           // background writer (included in diskwrites)
+  atomic<int> checkpoints; // Number of checkpoints taken
+  atomic<int> runios;      // Number of disk reads and writes that moved a
+                           // run of several adjacent pages at once
 
   void clear()
     {
-      accesses = diskreads = diskwrites = 0;
+      accesses = hits = diskreads = diskwrites = ringreuses = 0;
+      prefetches = prefetchhits = prefetchwasted = 0;
+      bgwrites = checkpoints = runios = 0;
+    }
+
+  double hitRatio() const
+    {
+      return accesses ? (double) hits / accesses : 0.0;
     }
       
   BufStats()
@@ -97,36 +321,217 @@ struct BufStats
 };
 
 
+// A page that was in the buffer pool, by file name, as saved at the
+// end of a session (see BufMgr::saveResidentSet()).  hot pages had
+// been referenced since the replacement policy last passed them by.
+struct ResidentPage
+{
+  string fileName;
+  int    pageNo;
+  bool   hot;
+};
+
+
+// The buffer manager may be used by several threads at once.  Pages
+// that are already resident are pinned and unpinned under the
+// striped latches of the hash table only.  Bringing a page in
+// (choosing and evicting a victim, publishing the new page) is
+// serialized by allocLatch, but the disk read itself is done outside
+// of it; other threads asking for that page wait until it is loaded.
+// Lock order: allocLatch, then a hash table latch, then the
+// replacement policy's latch or a file's latch, then the log's.
+//
+// Scans can ask for the next pages of a file's page chain to be read
+// ahead by a pool of I/O threads (see prefetch()).  Those pages come
+// in cold and are counted as wasted if evicted before they are used.
+//
+// A background writer (see BufWriter) cleans the frames that are
+// about to be evicted and takes periodic checkpoints, so evictions
+// and shutdown rarely have to write.  It holds cleanLatch while it
+// works; flushFile() and disposePage() take it before allocLatch.
+//
+// The pool and the frame descriptors live in address space reserved
+// up front for MAXPOOLBYTES of pages, so resize() can add frames or
+// drop the last ones without moving the pages that are pinned.
+
 class BufMgr 
 {
+  friend class BufIOPool;
+  friend class BufWriter;
 private:
-  unsigned int 	 clockHand;
   int   	 numBufs;    	// Number of pages in buffer pool
   BufHashTbl*    hashTable;  	// hash table mapping (File, page) to frame
   BufDesc*	 bufTable;  	// vector of status info, 1 per page
+  int		 maxBufs;	// frames the reserved address space holds
+  int		 descBufs;	// descriptors constructed so far
   BufStats	 bufStats;	// buffer pool statistics
+  BufReplacer*	 replacer;	// replacement policy choosing victims
+  mutex		 allocLatch;	// serializes frame allocation
+  BufIOPool*	 ioPool;	// read-ahead threads, NULL if none
+  BufWriter*	 writer;	// background writer, NULL if none
+  mutex		 cleanLatch;	// serializes background writes and flushes
+  mutex		 loadLatch;	// guards loaded
+  condition_variable loaded;	// notified when pages stop loading
+  deque<ResidentPage> departed; // pages last dropped by closing their
+				// file, newest last; under allocLatch
+  string	 name;		// which pool this is, for statistics
 
-  const Status allocBuf(int & frame);   // allocate a free frame.  
+  // pin (file,pageNo) if it is resident; returns false if it is not.
+  // touch sets the reference bit.
+  bool pinResident(const File* file, const int pageNo, int & frame,
+                   const bool touch = true);
+  // allocate a free frame to hold page (file,pageNo)
+  const Status allocBuf(const File* file, const int pageNo, int & frame);
+  // same, but recycle the frames of a bulk access ring
+  const Status allocRingBuf(BufRing* ring, const File* file,
+                            const int pageNo, int & frame);
+  // write out and forget the page held by an unpinned frame; evicted
+  // is false if another thread pinned the page in the meantime.
+  // remember tells the policy to keep the page's history.
+  const Status evictBuf(const int frame, bool & evicted,
+                        const bool remember = true);
+  // pin (file,pageNo) for writeBuf() if it is resident, dirty and
+  // unpinned, clearing its dirty bit
+  bool pinForWrite(const File* file, const int pageNo, int & frame);
+  // write out the dirty page in frame, with its hash table latch held
+  // in guard, leaving it resident.  The latch is dropped during the
+  // write, which takes along the dirty, unpinned pages adjacent to it
+  // in the file.
+  const Status writeBuf(const int frame, unique_lock<mutex> & guard);
+  // write out the dirty, unpinned pages among frames in file and page
+  // order.  Caller holds cleanLatch.
+  const Status writeFrames(const vector<int> & frames);
+  // write out the pages of todo that are still dirty and unpinned, in
+  // batches of runs of adjacent pages handed to pageIO.  background
+  // counts them as written by the background writer.
+  const Status writeBatch(vector<PendingWrite> & todo,
+                          const bool background);
+  // clean the frames the replacement policy will evict next
+  void cleanAhead();
+  // undo the loading of a page whose read failed
+  void abortLoad(const int frame);
+  // the page in frame is read in, or its read given up: wake the
+  // threads waiting for it
+  void finishLoad(const int frame);
+  // wait, without spinning, for the page in frame (pinned by the
+  // caller) to be read in
+  void waitForLoad(const int frame);
+  // read the pages of the chains that reqs start, each chain's next
+  // run of adjacent pages in the same batch (called by the I/O threads)
+  void prefetchChains(const vector<PrefetchReq> & reqs);
+  // follow chain through resident pages and add a read of the run of
+  // pages after them to batch; or set it inactive if it is done
+  void claimRun(ChainState & chain, vector<PageIOReq> & batch);
+  // mark the pages req read for chain as loaded and follow the chain
+  // through them
+  void finishRun(ChainState & chain, const PageIOReq & req);
+  // add the pages in the pool and the ones that left it recently
+  void residentPages(vector<ResidentPage> & pages);
   const void releaseBuf(int frame); // return unused frame to end of list
-  void advanceClock()
-  {
-	clockHand = (clockHand + 1) % numBufs;
-  }
 
 
 public:
   Page*	         bufPool;   // actual buffer pool
 
-  BufMgr(const int bufs);
+  BufMgr(const int bufs, const ReplPolicy policy = CLOCK,
+         const int ioThreads = IOTHREADS, const bool bgWriter = true);
   ~BufMgr();
 
-  const Status readPage(File* file, const int PageNo, Page*& page);
+  // ring is an optional bulk access ring (see BufRing); pages
+  // brought in through it do not displace the rest of the pool
+  const Status readPage(File* file, const int PageNo, Page*& page,
+                        BufRing* ring = NULL);
   const Status unPinPage(File* file, const int PageNo, const bool dirty);
-  const Status allocPage(File* file, int& PageNo, Page*& page); 
+  const Status allocPage(File* file, int& PageNo, Page*& page,
+                         BufRing* ring = NULL);
                         // allocates a new, empty page 
+
+  // same, but the pin is held by handle (releasing whatever handle
+  // held before) and undone through it.  Pages of a mapped file are
+  // read in place (see File::pinMapped()), not through a frame.
+  const Status readPage(File* file, const int PageNo, PageHandle & handle,
+                        BufRing* ring = NULL);
+  const Status allocPage(File* file, int& PageNo, PageHandle & handle,
+                         BufRing* ring = NULL);
+  // unpin the page in frame, which must be pinned
+  const Status unPinFrame(const int frame, const bool dirty);
+
+  // the pinned page in frame belongs to a logged file (see WAL)
+  bool  isLogged(const int frame) const
+  {
+	return bufTable[frame].file->isLogged();
+  }
+  // log the change of the pinned page in frame, which was before
+  // before; the whole page is logged if it has not been since it was
+  // read in
+  void  logChange(const int frame, const Page* before);
+  // the pinned page in frame was changed, or its version (see
+  // PageHandle::version())
+  void  pageChanged(const int frame)
+  {
+	bufTable[frame].version = ++BufDesc::clock;
+  }
+  unsigned long long pageVersion(const int frame) const
+  {
+	return bufTable[frame].version;
+  }
   const Status flushFile(const File* file); // writing out all dirty pages of the file
   const Status disposePage(File* file, const int PageNo); // dispose of page in file
+
+  // start reading page PageNo and the count-1 pages after it in the
+  // page chain in the background.  A hint only: nothing is pinned
+  // and no error is reported.
+  void  prefetch(File* file, const int PageNo,
+                 const int count = PREFETCHDEPTH);
+
+  // write out every dirty, unpinned page, file by file in page order;
+  // pages stay resident.  The log is then kept short (see WAL).
+  const Status checkpoint();
+
+  // log the whole of every page in the pool that has a logged change
+  // no later than lsn and may not be written out yet (pinned pages
+  // are not written), so that the log after lsn is enough to redo it
+  void imagePages(const LSN lsn);
+
+  // grow or shrink the pool to bufs frames.  The pages in the frames
+  // that go away are written out if dirty and dropped; returns
+  // PAGEPINNED (leaving the size alone) if one of them is pinned, and
+  // BADPOOLSIZE if bufs is below MINBUFS or beyond MAXPOOLBYTES.
+  const Status resize(const int bufs);
+
+  // Warm restart.  saveResidentSet() writes the pages in the pools to
+  // file path, each pool's followed by the pages that left it most
+  // recently because their file was closed, up to the size of the
+  // pool, in file and page order.  loadResidentSet() reads such a
+  // list back, and restorePage() has the I/O threads read one of its
+  // pages in the background (files must stay open for their pages to
+  // stay).  NULL pools are skipped.
+  static const Status saveResidentSet(const string & path,
+                                      BufMgr* const pools[],
+                                      const int count);
+  static const Status loadResidentSet(const string & path,
+                                      vector<ResidentPage> & pages);
+  void  restorePage(File* file, const int PageNo, const bool hot);
+
   void  printSelf();
+  void  setName(const string & poolName)
+  {
+	name = poolName;
+  }
+  void  printBufStats() const;  // print policy, hit ratio and I/O counts
+
+  const int getNumBufs() const
+  {
+	return numBufs;
+  }
+
+  // bytes of page frames in the pool
+  const long getPoolBytes() const;
+
+  const ReplPolicy getPolicy() const
+  {
+	return replacer->policy();
+  }
 
   const BufStats & getBufStats() const // get buffer pool usage
   {
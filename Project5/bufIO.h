@@ -0,0 +1,97 @@
+#ifndef BUFIO_H
+#define BUFIO_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "db.h"
+
+const int IOTHREADS = 2;      // default number of background I/O threads
+const int PREFETCHDEPTH = 4;  // pages a sequential scan reads ahead
+const int MAXIOQUEUE = 64;    // pending requests beyond which new ones are dropped
+const int IOBATCH = 8;        // requests an I/O thread serves together
+
+const int WRITERINTERVAL = 20;      // ms between background writer rounds
+const int CHECKPOINTINTERVAL = 1000; // ms between checkpoints
+const int CLEANAHEADFRACTION = 8;   // frames kept clean ahead of eviction
+                                    // (this fraction of the pool)
+
+class BufMgr;  // forward declaration of BufMgr class
+
+// request to bring page pageNo of file and the count-1 pages that
+// follow it in the file's page chain into the buffer pool.  hot
+// pages (restored from an earlier session) come in as referenced.
+struct PrefetchReq
+{
+  File*	file;
+  int	pageNo;
+  int	count;
+  bool	hot;
+};
+
+
+// A small pool of threads doing read-ahead for the buffer manager.
+// Requests are hints: they are dropped when the queue is full and
+// the pages they name may be gone by the time they are served.  A
+// thread takes up to IOBATCH queued requests at a time and has their
+// reads carried out together by pageIO (see pageIO.h).
+
+class BufIOPool
+{
+private:
+  BufMgr*	mgr;		// buffer manager the pages are read into
+  vector<thread> workers;
+  deque<PrefetchReq> queue;	// requests not yet picked up
+  vector<vector<const File*> > busy; // files each worker is reading
+  mutex		latch;		// protects queue, busy and stopping
+  condition_variable work;	// a request was queued, or shutdown
+  condition_variable idle;	// a worker finished a request
+  bool		stopping;
+
+  void run(const int id);	// body of worker thread id
+
+public:
+  BufIOPool(BufMgr* bufMgr, const int threads);
+  ~BufIOPool();			// waits for the workers to finish
+
+  // queue a request; returns false if it was dropped
+  bool submit(File* file, const int pageNo, const int count);
+
+  // queue the reading of just pageNo, which is never dropped (see
+  // BufMgr::restorePage())
+  void restore(File* file, const int pageNo, const bool hot);
+
+  // forget the queued requests for file and wait for the ones in
+  // progress.  Called before a file is flushed from the pool.
+  void cancel(const File* file);
+};
+
+
+// The background writer.  Every WRITERINTERVAL ms, or sooner when
+// woken because an eviction had to write a dirty page itself, it
+// writes out the dirty pages the replacement policy is about to
+// evict; every CHECKPOINTINTERVAL ms it writes out all dirty,
+// unpinned pages.
+
+class BufWriter
+{
+private:
+  BufMgr*	mgr;		// buffer manager whose pages are written
+  thread	worker;
+  mutex		latch;		// protects kicked and stopping
+  condition_variable wakeup;
+  bool		kicked;		// woken before the interval was over
+  bool		stopping;
+
+  void run();
+
+public:
+  BufWriter(BufMgr* bufMgr);
+  ~BufWriter();			// waits for the current round to finish
+
+  void wake();			// start a round now
+};
+
+#endif
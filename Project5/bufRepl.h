@@ -0,0 +1,304 @@
+#ifndef BUFREPL_H
+#define BUFREPL_H
+
+#include <atomic>
+#include <list>
+#include <map>
+#include <mutex>
+#include <set>
+#include <vector>
+#include "db.h"
+
+// define if debug output wanted
+//#define DEBUGREPL
+
+// buffer replacement policies that the buffer manager can be
+// configured with at startup
+enum ReplPolicy { CLOCK, LRUK, TWOQ, ARC };
+
+// map a policy name ("clock", "lruk", "2q", "arc") to a policy;
+// returns false if the name is not recognized
+bool getReplPolicy(const char* name, ReplPolicy& policy);
+
+// returns the printable name of a policy
+const char* replPolicyName(const ReplPolicy policy);
+
+
+class BufDesc;  // forward declaration of the frame descriptor
+
+// (file,pageNo) pair naming a page that a bulk access ring put into
+// a frame
+struct BufPageKey
+{
+  const File* file;
+  int pageNo;
+
+  bool operator < (const BufPageKey & other) const
+  {
+    if (file != other.file) return file < other.file;
+    return pageNo < other.pageNo;
+  }
+};
+
+// id of a page used by the policies that remember pages which are no
+// longer resident in the buffer pool.  The file is known by its id
+// (File::getId()): a File is deleted when it is closed, and another
+// one may be allocated at its address.
+struct GhostKey
+{
+  int fileId;
+  int pageNo;
+
+  bool operator < (const GhostKey & other) const
+  {
+    if (fileId != other.fileId) return fileId < other.fileId;
+    return pageNo < other.pageNo;
+  }
+};
+
+
+// Abstract replacement policy.  The buffer manager tells the policy
+// about every hit, every page brought into a frame and every frame
+// that is released, and asks it for a victim frame when it needs
+// one.  A policy must never return a frame that is pinned.
+//
+// The buffer manager calls the policy from several threads at once:
+// pickVictim() and evicted() under its allocation latch, the others
+// also from threads that only hold a pin on the frame.  Policies that
+// keep lists protect them with latch.
+//
+// Frames that hold no page are kept on a free list, which the
+// policies that keep lists push in freed() and take victims from
+// first, so that they need not look through the pool for one.
+
+class BufReplacer
+{
+protected:
+  BufDesc*	bufTable;	// frame descriptors of the buffer pool
+  int		numBufs;	// number of frames in the buffer pool
+  mutex		latch;		// protects the policy's own state
+
+  // access to the frame descriptors (BufDesc is private)
+  bool isValid(const int frame) const;
+  bool isPinned(const int frame) const;
+  bool isReferenced(const int frame) const;
+  void clearReferenced(const int frame);
+  GhostKey ghostOf(const int frame) const;
+
+  // frames freed since they were last taken off the list, most
+  // recently freed last; frames may have been taken for a page since.
+  // listed[f] is true if f is on the list.
+  vector<int>	freeList;
+  vector<bool>	listed;
+
+  // put frame on the free list.  Called with latch held.
+  void addFree(const int frame);
+  // take an invalid, unpinned (free) frame off the free list, -1 if
+  // all are in use.  Called with latch held.
+  int freeFrame();
+  // list the frames a pool growing to bufs frames gains.  Called with
+  // latch held, before numBufs changes.
+  void resizeFree(const int bufs);
+
+public:
+  BufReplacer(BufDesc* table, const int bufs);
+  virtual ~BufReplacer() {}
+
+  // factory used by the buffer manager
+  static BufReplacer* create(const ReplPolicy policy, BufDesc* table,
+			     const int bufs);
+
+  virtual ReplPolicy policy() const = 0;
+
+  // page in frame was requested again while resident
+  virtual void hit(const int frame) = 0;
+
+  // a page has just been placed into frame (its descriptor is set)
+  virtual void loaded(const int frame) = 0;
+
+  // the page in frame, which stays resident, is to be treated as if
+  // it had just been placed there (a page read ahead is requested for
+  // the first time): its history starts afresh
+  virtual void restarted(const int frame) = 0;
+
+  // frame was invalidated by flushFile() or disposePage(), or
+  // recycled by a bulk access ring
+  virtual void freed(const int frame) = 0;
+
+  // the page in frame, chosen by pickVictim(), is being evicted; its
+  // descriptor still names the page
+  virtual void evicted(const int frame) = 0;
+
+  // the page in frame will probably not be used again soon (it was
+  // read by a bulk scan): make it the next candidate for eviction
+  virtual void demote(const int frame) = 0;
+
+  // choose a frame to hold page (file,pageNo).  The frame is either
+  // free or holds an unpinned page that the caller will try to evict;
+  // another thread may pin it first, in which case the caller asks
+  // again.  returns OK or BUFFEREXCEEDED if every frame is pinned
+  virtual Status pickVictim(const File* file, const int pageNo,
+			    int& frame) = 0;
+
+  // up to n valid, unpinned frames that are likely to be chosen as
+  // victims soon, without changing any state (used by the background
+  // writer to clean them ahead of time)
+  virtual void nextVictims(const int n, vector<int> & frames) = 0;
+
+  // the pool now has bufs frames.  When it shrinks, the frames that
+  // go away have already been freed.  Called under allocLatch.
+  virtual void resize(const int bufs);
+};
+
+
+// The classic clock (second chance) algorithm.  The reference bits
+// live in the (atomic) frame descriptors and the hand is advanced
+// atomically, so the clock needs no latch.
+
+class ClockReplacer : public BufReplacer
+{
+private:
+  atomic<unsigned int> clockHand;
+  // move the hand and return the frame it now points at
+  int advanceClock()
+  {
+	return clockHand.fetch_add(1) % numBufs;
+  }
+
+public:
+  ClockReplacer(BufDesc* table, const int bufs);
+
+  ReplPolicy policy() const { return CLOCK; }
+  void hit(const int frame);
+  void loaded(const int frame);
+  void restarted(const int frame);
+  void freed(const int frame);
+  void evicted(const int frame);
+  void demote(const int frame);
+  Status pickVictim(const File* file, const int pageNo, int& frame);
+  void nextVictims(const int n, vector<int> & frames);
+};
+
+
+// LRU-K (O'Neil et al.).  The victim is the unpinned page whose K-th
+// most recent reference lies furthest in the past.  Pages with fewer
+// than K references have an infinite backward distance and are
+// evicted first, oldest last reference first.
+//
+// The resident frames are kept sorted in that order, so the victim is
+// the first one that is not pinned.
+
+class LRUKReplacer : public BufReplacer
+{
+private:
+  // where a frame stands in the eviction order: (finite distance,
+  // time), then the frame
+  typedef pair<pair<bool, unsigned long>, int> Rank;
+
+  int		K;		// number of references remembered
+  unsigned long	now;		// logical time, bumped on every reference
+  vector<unsigned long> hist;	// K timestamps per frame, most recent first
+  set<Rank>	order;		// resident frames, next victim first
+  vector<bool>	ranked;		// frame is in order
+
+  Rank rank(const int frame) const;
+  void unrank(const int frame);
+  void reference(const int frame);
+
+public:
+  LRUKReplacer(BufDesc* table, const int bufs, const int k = 2);
+
+  ReplPolicy policy() const { return LRUK; }
+  void hit(const int frame);
+  void loaded(const int frame);
+  void restarted(const int frame);
+  void freed(const int frame);
+  void evicted(const int frame);
+  void demote(const int frame);
+  Status pickVictim(const File* file, const int pageNo, int& frame);
+  void nextVictims(const int n, vector<int> & frames);
+  void resize(const int bufs);
+};
+
+
+// 2Q (Johnson and Shasha, full version).  Pages referenced once live
+// in the FIFO queue A1in; once they are evicted their ids are kept
+// in the ghost queue A1out.  A page that is requested again while in
+// A1out is considered hot and goes to the LRU queue Am.
+
+class TwoQReplacer : public BufReplacer
+{
+private:
+  enum Queue { NONE, A1IN, AM };
+
+  int		kin;		// target size of A1in
+  int		kout;		// maximum size of A1out
+  list<int>	a1in;		// resident, seen once (FIFO, head oldest)
+  list<int>	am;		// resident, hot (LRU, head oldest)
+  list<GhostKey> a1out;	// ghost ids evicted from A1in
+  map<GhostKey, list<GhostKey>::iterator> a1outIdx;
+  vector<Queue>	queueOf;	// queue of each frame
+  vector<list<int>::iterator> pos;  // position of each frame in its queue
+
+  int firstUnpinned(const list<int> & q) const;
+  void unlink(const int frame);
+
+public:
+  TwoQReplacer(BufDesc* table, const int bufs);
+
+  ReplPolicy policy() const { return TWOQ; }
+  void hit(const int frame);
+  void loaded(const int frame);
+  void restarted(const int frame);
+  void freed(const int frame);
+  void evicted(const int frame);
+  void demote(const int frame);
+  Status pickVictim(const File* file, const int pageNo, int& frame);
+  void nextVictims(const int n, vector<int> & frames);
+  void resize(const int bufs);
+};
+
+
+// ARC (Megiddo and Modha).  T1 holds resident pages seen once, T2
+// resident pages seen at least twice; B1 and B2 remember the ids of
+// pages recently evicted from T1 and T2.  Hits in the ghost lists
+// move the target size p of T1 so the split between recency and
+// frequency adapts to the workload.
+
+class ARCReplacer : public BufReplacer
+{
+private:
+  enum Queue { NONE, T1, T2 };
+
+  int		c;		// number of frames
+  int		p;		// target size of T1
+  list<int>	t1, t2;		// resident lists (head is LRU)
+  list<GhostKey> b1, b2;	// ghost lists (head is LRU)
+  map<GhostKey, list<GhostKey>::iterator> b1Idx, b2Idx;
+  vector<Queue>	queueOf;
+  vector<list<int>::iterator> pos;
+
+  int firstUnpinned(const list<int> & q) const;
+  void unlink(const int frame);
+  void ghost(list<GhostKey> & b,
+	     map<GhostKey, list<GhostKey>::iterator> & idx,
+	     const int frame);
+  void dropLRU(list<GhostKey> & b,
+	       map<GhostKey, list<GhostKey>::iterator> & idx);
+
+public:
+  ARCReplacer(BufDesc* table, const int bufs);
+
+  ReplPolicy policy() const { return ARC; }
+  void hit(const int frame);
+  void loaded(const int frame);
+  void restarted(const int frame);
+  void freed(const int frame);
+  void evicted(const int frame);
+  void demote(const int frame);
+  Status pickVictim(const File* file, const int pageNo, int& frame);
+  void nextVictims(const int n, vector<int> & frames);
+  void resize(const int bufs);
+};
+
+#endif
@@ -10,6 +10,11 @@
 
 #define RELCATNAME   "relcat"           // name of relation catalog
 #define ATTRCATNAME  "attrcat"          // name of attribute catalog
+#define SYSBUFSTATS  "sys_bufstats"     // buffer pool counters per relation
+#define SYSIOSTATS   "sys_iostats"      // I/O latency histograms per relation
+#define SYSZIPSTATS  "sys_zipstats"     // compression ratio and cost per relation
+#define SYSRELPREFIX "sys_"             // reserved for system relations
+#define WARMSETNAME  ".warmset"         // buffer pool contents at last quit
 #define MAXNAME      32                 // length of relName, attrName
 #define MAXSTRINGLEN 255                // max. length of string attribute
 
@@ -115,7 +120,8 @@ class AttrCatalog : public HeapFile {
 extern RelCatalog  *relCat;
 extern AttrCatalog *attrCat;
 extern Error error;
-extern Status createHeapFile(const string filename);
+extern Status createHeapFile(const string filename,
+                             const int recLen = 0);
 extern Status destroyHeapFile(const string filename);
 
 #endif
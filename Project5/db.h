@@ -2,7 +2,15 @@
 #define DB_H
 
 #include <sys/types.h>
+#include <atomic>
 #include <functional>
+#include <list>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
 #include "error.h"
 #include <string.h>
 using namespace std;
@@ -12,13 +20,183 @@ using namespace std;
 //#define DEBUGIO
 //#define DEBUGFREE
 
+// When set before files are opened, relation files are opened with
+// O_DIRECT so that pages are cached by the buffer pool only and not
+// a second time in the OS page cache.  Set from minirel's -d switch.
+extern bool DirectIO;
+
+// Files named here are mapped read-only when they are opened, and
+// their pages read in place rather than copied into the buffer pool
+// until something writes to them.  Meant for read-mostly relations;
+// set from minirel's -r switch.
+extern set<string> MappedFiles;
+
+// Base relations created while this is set are stored compressed
+// (see File).  Set from minirel's -z switch.
+extern bool CompressFiles;
+
+// alignment of buffers handed to the kernel for direct I/O; pages
+// outside the buffer pool are bounced through a buffer aligned so
+const unsigned DIRECTALIGN = 4096;
+
+// buckets of the I/O latency histograms: bucket 0 counts operations
+// that took less than a microsecond, bucket i > 0 those that took
+// [2^(i-1), 2^i) microseconds; the last bucket also takes anything
+// slower
+const int LATBUCKETS = 24;
+
+// Counters kept per file (and so per relation), by name, from the
+// first time the file is opened until it is destroyed.  The buffer
+// manager counts how the file's pages fare in the pool, File counts
+// the reads and writes that reach the disk and how long they take.
+struct FileStats
+{
+  string name;
+  atomic<int> hits;        // page requests satisfied by the pool
+  atomic<int> misses;      // page requests that had to read the page
+  atomic<int> evictions;   // pages evicted to make room for others
+  atomic<int> dirtywrites; // dirty pages written back by the pool
+  atomic<int> pinfails;    // requests failed because all frames were pinned
+  atomic<int> reads;       // pages read from disk
+  atomic<int> writes;      // pages written to disk
+  atomic<int> readLatency[LATBUCKETS];
+  atomic<int> writeLatency[LATBUCKETS];
+  // compressed files only: bytes of the pages written before and after
+  // compression and of the pages read after and before decompression,
+  // and the time spent on each
+  atomic<long long> zipIn, zipOut, unzipOut, unzipIn;
+  atomic<long long> zipNanos, unzipNanos;
+
+  FileStats(const string & fileName);
+
+  // statistics of file fileName, created on first use
+  static FileStats* lookup(const string & fileName);
+  // drop the statistics of a destroyed file
+  static void forget(const string & fileName);
+  // call visit on the statistics of every file, by name
+  static void forEach(const function<void(const FileStats &)> & visit);
+
+  // bucket of the latency histograms for an operation of micros
+  static int latencyBucket(const long micros);
+
+private:
+  static map<string, FileStats*> all;
+  static mutex latch;      // protects all
+};
+
+// files grow in extents: when the last allocated page is used up the
+// file is extended by a quarter of its size, but by no fewer than
+// MINEXTENT and no more than MAXEXTENT pages at a time
+const int MINEXTENT = 8;
+const int MAXEXTENT = 1024;
+
+// most pages moved by one readPages() or writePages() call
+const int MAXIOPAGES = 32;
+
+// structure of DB (header) page
+
+typedef struct {
+  int nextFree;                         // page # of next page on free list
+  int firstPage;                        // page # of first page in file
+  int numPages;                         // total # of pages in file
+  int format;                           // FILEFORMAT when the file was created
+} DBPage;
+
+// version of the layout of a file and its pages, stamped in the
+// header page when the file is created.  Files made before it was
+// (format 0) left Page::freeSlot uninitialized, and are not opened.
+const int FILEFORMAT = 1;
+
+// A compressed file keeps its header page as is and every other page
+// compressed, in a slot of whole ZIPUNITs anywhere past the header
+// page.  The page map saying where each page is goes into a slot of
+// its own when the header is written back, and ZipHeader, which
+// follows DBPage on the header page, says where that is.
+
+const int ZIPUNIT = 64;
+const int ZIPMAGIC = 0x5a495031;
+
+struct ZipSlot {
+  unsigned int unit;                    // first unit, 0 if never written
+  unsigned short units;                 // units of the slot
+  unsigned short length;                // bytes used, PAGESIZE if not compressed
+};
+
+typedef struct {
+  int magic;                            // ZIPMAGIC if the file is compressed
+  int mapPages;                         // entries of the page map on disk
+  unsigned int mapUnit;                 // slot of the page map, 0 if none
+  unsigned int mapUnits;
+} ZipHeader;
+
+// log sequence number of a write-ahead log record (see wal.h); 0 is
+// before every record
+typedef long long LSN;
+
 // forward class definition for db
 class DB;
+class BufMgr;
+class File;
+
+// most unix files kept open at once for the open Files of a process
+// (see FdCache)
+const int MAXOPENFDS = 256;
+
+// The descriptors of the open Files, by file id.  Only so many stay
+// open: when another one is needed the least recently used one that
+// is not pinned is closed, and opened again the next time its File
+// reads or writes.  That way the partitions of a hash join and the
+// runs of a sort can be open by the thousand.
+
+class FdCache
+{
+public:
+  FdCache(const int limit);
+
+  // a descriptor of file, opened if need be, pinned until release();
+  // -1 if it cannot be opened
+  int acquire(const File* file);
+  void release(const File* file);
+  // take fd, just opened for file, into the cache
+  void add(const File* file, const int fd);
+  // close the descriptor of file if it is open and forget it
+  const Status remove(const File* file);
+
+  void setLimit(const int newLimit);
+  // descriptors opened again after they were closed to make room
+  int getReopens() const
+    {
+      return reopens;
+    }
+
+private:
+  struct Entry
+  {
+    int fd;                             // -1 while closed
+    int pins;
+    list<int>::iterator unused;         // place in lru while not pinned
+    Entry() : fd(-1), pins(0) {}
+  };
+
+  void makeRoom();                      // close down to limit; latch held
+
+  unordered_map<int, Entry> entries;    // by file id
+  list<int> lru;                        // unpinned open ones, oldest first
+  int open;                             // descriptors open
+  int limit;
+  atomic<int> reopens;
+  mutex latch;
+};
+
+extern FdCache* fdCache;
 
 // class definition for open files
 class File {
   friend class DB;
   friend class OpenFileHashTbl;
+  friend class PageIO;
+  friend class WAL;
+  friend class FdCache;
 
  public:
 
@@ -28,7 +206,79 @@ class File {
 		  Page* pagePtr) const;       // read page from file
   const Status writePage(const int pageNo,
 		   const Page* pagePtr);      // write page to file
+
+  // read or write the count (at most MAXIOPAGES) pages starting at
+  // pageNo with one system call; pages[i] holds page pageNo + i
+  const Status readPages(const int pageNo, const int count,
+                         Page* const pages[]) const;
+  const Status writePages(const int pageNo, const int count,
+                          const Page* const pages[]);
+
   const Status getFirstPage(int& pageNo) const;     // returns pageNo of first page
+  const int getNumPages() const;                    // pages in file, header included
+  const Status flushHeader();                       // write back the header page
+
+  // changes to the file are logged (see WAL): it is not a temporary
+  // file and logging was on when it was opened
+  bool isLogged() const
+    {
+      return logged;
+    }
+
+  // pages are stored compressed (see ZipSlot)
+  bool isCompressed() const
+    {
+      return zipped;
+    }
+
+  // pages of a mapped file (see MappedFiles) are pinned in the mapping
+  // by reference count; pinMapped() returns NULL once the file has
+  // gone over to the buffer pool or if pageNo is not mapped
+  bool isMapped() const
+    {
+      return mapped;
+    }
+  Page* pinMapped(const int pageNo);
+  void unpinMapped()
+    {
+      mapPins--;
+    }
+  const int getMappedPins() const
+    {
+      return mapPins;
+    }
+  // serve the pages from the buffer pool from now on, so that they can
+  // be changed; the mapping stays until the file is closed for pages
+  // still pinned in it
+  void endMapping()
+    {
+      mapped = false;
+    }
+
+  const string & getName() const
+    {
+      return fileName;
+    }
+
+  // number told apart from that of every other File of this session,
+  // even one opened later at the same address
+  int getId() const
+    {
+      return fileId;
+    }
+
+  // buffer pool holding the pages of this file, chosen when the file
+  // was opened
+  BufMgr* getPool() const
+    {
+      return pool;
+    }
+
+  // counters of this file; see FileStats
+  FileStats & getStats() const
+    {
+      return *stats;
+    }
 
   bool operator == (const File & other) const
     {
@@ -40,16 +290,37 @@ class File {
   File(const string &fname);                   // initialize
   ~File();                  // deallocate file object
 
-  static const Status create(const string &fileName);
+  // logged says whether to log the creation (see WAL), compressed
+  // whether to store the pages compressed
+  static const Status create(const string &fileName, const bool logged,
+                             const bool compressed);
   static const Status destroy(const string &fileName);
 
   const Status open();
   const Status close();
+  void openDirect();                    // open the file for direct I/O
+  void openMapping();                   // map the file for reading
+  const Status openZipped(const ZipHeader & zip); // read the page map
 
   const Status intread(const int pageNo,
 		 Page* pagePtr) const;        // internal file read
   const Status intwrite(const int pageNo,
 		  const Page* pagePtr);       // internal file write
+  const Status intreadv(const int pageNo, const int count,
+                        Page* const pages[]) const;
+  const Status intwritev(const int pageNo, const int count,
+                         const Page* const pages[]);
+  const Status intflushHeader();        // flushHeader without the latch
+  // write back the headers and page maps of the open compressed files
+  // that are logged; the maps are not logged, so a log file must not be
+  // dropped before they are on disk (see WAL::dropPrevious())
+  static const Status flushZipped();
+  const Status readZipped(const int pageNo, Page* pagePtr) const;
+  const Status writeZipped(const int pageNo, const Page* pagePtr);
+  unsigned int allocUnits(const unsigned int units);
+  void freeUnits(const unsigned int unit, const unsigned int units);
+  void logHeader();                     // log the header if logged
+  const Status extend(const int pages); // make room for pages more pages
 
 #ifdef DEBUGFREE
   void listFree();                      // list free pages
@@ -57,10 +328,34 @@ class File {
 
   string fileName;                    // The name of the file
   int openCnt;                        // # times file has been opened
-  int unixFile;                       // unix file stream for file
+  int fileId;                         // key of the descriptor in fdCache
+  bool direct;                        // the file is opened with O_DIRECT
+  unsigned int dioAlign;              // memory alignment direct I/O needs
+  mutable mutex latch;                // serializes header and extent updates
+  FileStats* stats;                   // counters, shared by every open of the file
+  DBPage header;                      // copy of the header page, valid while open
+  bool headerDirty;                   // header differs from the one on disk
+  int extentEnd;                      // pages the file has room for on disk
+  BufMgr* pool;                       // buffer pool of the file's pages
+  char* mapping;                      // read-only mapping, NULL if none
+  int mappedPages;                    // pages covered by mapping
+  atomic<bool> mapped;                // pages are read from mapping
+  atomic<int> mapPins;                // pins on pages of mapping
+  bool logged;                        // changes are logged
+  LSN headerLSN;                      // last logged change to header
+  bool zipped;                        // pages are stored compressed
+  mutable mutex zipLatch;             // protects the fields below
+  ZipHeader zip;                      // copy of the ZipHeader on disk
+  vector<ZipSlot> pageMap;            // slot of each page, by page number
+  multimap<unsigned int, unsigned int> freeRuns; // units -> first unit
+  vector<pair<unsigned int, unsigned int> > pendingRuns; // freed, still mapped on disk
+  unsigned int endUnit;               // units in use from the start of file
+  bool mapDirty;                      // pageMap differs from the one on disk
+
+  static set<File*> zippedFiles;      // open, compressed and logged
+  static mutex zippedLatch;           // protects zippedFiles
 };
 
-class BufMgr;
 extern BufMgr* bufMgr;
 
 // declarations for hash table of open files
@@ -109,17 +404,19 @@ class DB {
   const Status openFile(const string & fileName, File* & file);  // open a file
   const Status closeFile(File* file);         // close a file
 
+  // open a file and keep it open until it is destroyed or
+  // releaseHolds() is called, so that its pages can stay in the
+  // buffer pool between uses (see BufMgr::restorePage())
+  const Status holdFile(const string & fileName, File* & file);
+  void releaseHolds();
+
  private:
+  const Status intclose(File* file);    // closeFile without the latch
+
   OpenFileHashTbl   openFiles;    // list of open files
+  vector<File*>     held;         // files opened by holdFile()
+  mutex             latch;        // protects openFiles, held and open counts
 };
 
 
-// structure of DB (header) page
-
-typedef struct {
-  int nextFree;                         // page # of next page on free list
-  int firstPage;                        // page # of first page in file
-  int numPages;                         // total # of pages in file
-} DBPage;
-
 #endif
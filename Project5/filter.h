@@ -0,0 +1,51 @@
+#ifndef FILTER_H
+#define FILTER_H
+
+#include "heapfile.h"
+
+// The predicates of scans are evaluated a page at a time: filterPage()
+// compares the attribute of every record on a page with the value of
+// the predicate in one go and marks the records that satisfy it in a
+// bitmap, which HeapFileScan::scanNext() then walks.  INTEGER and
+// FLOAT attributes are gathered and compared eight at a time with
+// AVX2 where the CPU has it and four at a time with SSE2 otherwise;
+// STRING attributes are compared sixteen bytes at a time with SSE2.
+
+// There is a kernel for every type and operator, so that filtering a
+// page makes no decisions record by record; compileFilter() picks the
+// one for each predicate when its scan starts.
+
+// A conjunction is evaluated one operand at a time, each operand
+// looking only at the records that all before it accepted, and a
+// disjunction likewise at those that all before it rejected.  The
+// operands are kept in order of how often they decide a record, as
+// counted over the pages filtered so far.
+
+// use the vector kernels; cleared to measure the scalar ones
+extern bool FilterSIMD;
+
+// a filter of the attribute of type at offset, length bytes long,
+// compared with value by op; value is copied
+ScanFilter filterTerm(const int offset, const int length,
+                      const Datatype type, const char* value,
+                      const Operator op);
+
+// a filter satisfied by records that satisfy both a and b (FILTERAND)
+// or either (FILTEROR)
+ScanFilter filterOf(const FilterKind kind, const ScanFilter & a,
+                    const ScanFilter & b);
+
+// check the predicates of filter and choose their kernels; returns
+// BADSCANPARM for a predicate that makes no sense
+const Status compileFilter(ScanFilter & filter);
+
+// set the bit in selected of every record of page that satisfies
+// filter, which must have been compiled (of every record if filter is
+// NULL), and clear the others; returns the number of slots of page
+int filterPage(const Page* page, ScanFilter* filter, SlotBitmap selected);
+
+// whether the attribute at attr, of a record long enough to hold it,
+// satisfies pred
+bool matchAttr(const char* attr, const Predicate & pred);
+
+#endif
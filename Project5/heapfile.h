@@ -22,6 +22,49 @@ const unsigned MAXNAMESIZE = 50;
 enum Datatype { STRING, INTEGER, FLOAT };    // attribute data types
 enum Operator { LT, LTE, EQ, GTE, GT, NE };  // scan operators
 
+// filters the n records of a page, whose data starts at data, for a
+// predicate of one type and operator (see filter.h)
+struct Predicate;
+typedef void (*FilterKernel)(const char* data, const int* offs,
+                             const int* lens, const int n,
+                             const Predicate & pred,
+                             unsigned long long* selected);
+
+// the predicate of a scan: the attribute of type at offset, length
+// bytes long, compared with a value by op
+struct Predicate
+{
+  int offset;
+  int length;
+  Datatype type;
+  Operator op;
+
+  // the value, decoded when the predicate is made (see filterTerm())
+  int intValue;
+  float floatValue;
+  vector<char> stringValue;     // NUL padded for sixteen-byte compares
+
+  FilterKernel kernel;          // set by compileFilter()
+};
+
+// the filter of a scan: a predicate, or the conjunction or disjunction
+// of other filters
+enum FilterKind { FILTERTERM, FILTERAND, FILTEROR };
+
+struct ScanFilter
+{
+  FilterKind kind;
+  Predicate term;                       // of a FILTERTERM
+  vector<ScanFilter> operands;          // of a FILTERAND or FILTEROR
+
+  // records tested against the filter and those that satisfied it,
+  // starting from a guess: the operands of a conjunction are tried
+  // in the order that rejects records soonest, and those of a
+  // disjunction in the order that accepts them soonest
+  double tested;
+  double passed;
+};
+
 struct FileHdrPage
 {
   char		fileName[MAXNAMESIZE];   // name of file
@@ -29,6 +72,7 @@ struct FileHdrPage
   int		lastPage;	// pageNo of last data page in file
   int		pageCnt;	// number of pages
   int		recCnt;		// record count
+  int		recLen;		// length of every record, 0 if they vary
 };
 
 
@@ -36,14 +80,15 @@ struct FileHdrPage
 class HeapFile {
 protected:
    File* 	filePtr;        // underlying DB File object
-   FileHdrPage*  headerPage;	// pinned file header page in buffer pool
+   BufMgr*	pool;		// buffer pool of the file's pages
+   PageHandle	header;		// pin on the file header page
+   FileHdrPage*  headerPage;	// contents of the header page
    int		headerPageNo;	// page number of header page
-   bool		hdrDirtyFlag;   // true if header page has been updated
 
-   Page* 	curPage;	// data page currently pinned in buffer pool
+   PageHandle	curPage;	// data page currently pinned in buffer pool
    int   	curPageNo;	// page number of pinned page
-   bool  	curDirtyFlag;   // true if page has been updated
    RID   	curRec;         // rid of last record returned
+   BufRing*	ring;		// bulk access ring for data pages, NULL if none
 
 public:
 
@@ -58,9 +103,19 @@ public:
 
   // given a RID, read record from file, returning pointer and length
   const Status getRecord(const RID &rid, Record & rec);
+
+protected:
+  // pages read in place from a mapped file cannot be changed: move the
+  // file over to the buffer pool and pin the header and current page
+  // there before changing them
+  const Status makeWritable();
 };
 
 
+// A scan over a file larger than BULKSCANFRACTION of the buffer pool
+// reads its pages through a private ring of frames (see BufRing)
+const int BULKSCANFRACTION = 4;  // i.e. a quarter of the pool
+
 class HeapFileScan : public HeapFile
 {
 public:
@@ -76,6 +131,9 @@ public:
                            const char* filter, 
                            const Operator op);
 
+    // start a scan for the records that satisfy filter (see filter.h)
+    const Status startScan(const ScanFilter & filter);
+
     const Status endScan(); // terminate the scan
     const Status markScan(); // save current position of scan
     const Status resetScan(); // reset scan to last marked location
@@ -89,15 +147,17 @@ public:
     // delete current record 
     const Status deleteRecord();
 
+    // delete the current record and all the records after it on the
+    // current page that satisfy the scan, compacting the page once;
+    // the scan goes on from the next page
+    const Status deleteRecords();
+
     // marks current page of scan dirty
     const Status markDirty();
 
 private:
-    int   offset;            // byte offset of filter attribute
-    int   length;            // length of filter attribute
-    Datatype type;           // datatype of filter attribute
-    const char* filter;      // comparison value of filter
-    Operator op;             // comparison operator of filter
+    ScanFilter filter;       // filter of the scan
+    bool  filtered;          // false if no filtering was requested
 
      // The following variables are used to preserve the state
     // of the scan when the method markScan() is invoked.
@@ -106,7 +166,15 @@ private:
     int   markedPageNo;	// page number of pinned page
     RID   markedRec;         // rid of last record returned
 
-    const bool matchRec(const Record & rec) const;
+    // records of page selectedPageNo that satisfy the filter, found a
+    // page at a time (see filterPage()), and the slots and version
+    // (see PageHandle::version()) the page had then
+    SlotBitmap selected;
+    int   selectedPageNo;
+    int   selectedSlots;
+    unsigned long long selectedVersion;
+
+    void readAhead();  // prefetch the pages following the current one
 };
 
 
@@ -114,7 +182,10 @@ class InsertFileScan : public HeapFile
 {
 public:
 
-    InsertFileScan(const string & name, Status & status);
+    // bulk is true if many pages will be appended and not read back
+    // soon (e.g. sort runs): new pages then go through a private ring
+    InsertFileScan(const string & name, Status & status,
+                   const bool bulk = false);
 
     // end filtered scan
     ~InsertFileScan();
@@ -1,8 +1,26 @@
 #ifndef PAGE_H
 #define PAGE_H
 
+#include <type_traits>
 #include "error.h"
 
+// page size in bytes, fixed at build time (make PAGESIZE=8192).  Every
+// file of a database is laid out in pages of this size, so a database
+// can only be used by binaries built with the size that created it.
+#ifndef MINIREL_PAGESIZE
+#define MINIREL_PAGESIZE 1024
+#endif
+
+const unsigned PAGESIZE = MINIREL_PAGESIZE;
+static_assert(PAGESIZE >= 1024 && PAGESIZE <= 32768
+              && (PAGESIZE & (PAGESIZE - 1)) == 0,
+              "PAGESIZE must be a power of two from 1K to 32K");
+
+// type of the offsets and lengths kept in a page.  short up to 16K;
+// a 32K data area comes within a few bytes of SHRT_MAX, so offsets,
+// lengths and counts are widened to int there
+typedef std::conditional<(PAGESIZE <= 16384), short, int>::type pageoff_t;
+
 struct RID{
     int  pageNo;
     int	 slotNo;
@@ -18,40 +36,78 @@ struct Record
 
 // slot structure
 struct slot_t {
-        short	offset;  
-        short	length;  // equals -1 if slot is not in use
+        pageoff_t	offset;  
+        pageoff_t	length;  // equals -1 if slot is not in use
 };
 
-const unsigned PAGESIZE = 1024;
-const unsigned DPFIXED= sizeof(slot_t)+4*sizeof(short)+2*sizeof(int);
+const unsigned DPFIXED= sizeof(slot_t)+4*sizeof(pageoff_t)+2*sizeof(int);
 const unsigned PAGEDATASIZE = PAGESIZE-DPFIXED+sizeof(slot_t);
 // size of the data area of a page
 
+// a bit for every slot a page can have, by slot number
+const int MAXPAGESLOTS = PAGESIZE / sizeof(slot_t);
+typedef unsigned long long SlotBitmap[(MAXPAGESLOTS + 63) / 64];
+
+// the length in the first slot of a fixed-width page (see below)
+const int FIXEDSLOT = -2;
+
 // Class definition for a minirel data page.   
-// The design assumes that records are kept compacted when
-// deletions are performed. Notice, however, that the slot
-// array cannot be compacted.  Notice, this class does not keep
-// the records align, relying instead on upper levels to take
-// care of non-aligned attributes
+// Deleting a record leaves a hole in the data area, which is only
+// squeezed out when an insertion needs the room or by deleteRecords().
+// The unused slots are chained together, from freeSlot through their
+// offsets, so that an insertion reuses one without looking for it.
+// Notice, however, that the slot array cannot be compacted.
+// Notice, this class does not keep the records align, relying
+// instead on upper levels to take care of non-aligned attributes
+
+// A page initialized for records of one length (see init()) is laid
+// out without slots instead.  Its first slot holds the record length,
+// with FIXEDSLOT as its length to tell the two layouts apart; data[]
+// starts with a bitmap of the records present, a bit per slot number,
+// and the records follow it back to back, record i at freePtr +
+// i * length.  freeSlot is then the first slot number that may be
+// free, slotCnt as ever covers the slot numbers up to the last
+// record, and freeSpace counts the free bytes of the record array.
 
 class Page {
 private:
     char 	data[PAGESIZE - DPFIXED]; 
     slot_t 	slot[1]; // first element of slot array - grows backwards!
-    short	slotCnt; // number of slots in use;
-    short	freePtr; // offset of first free byte in data[]
-    short	freeSpace; // number of bytes free in data[]
-    short	dummy;	// for alignment purposes
+    pageoff_t	slotCnt; // number of slots in use;
+    pageoff_t	freePtr; // offset of first free byte in data[]
+    pageoff_t	freeSpace; // number of bytes free in data[]
+    pageoff_t	freeSlot; // first unused slot, -1 if none
     int		nextPage; // forwards pointer
     int		curPage;  // page number of current pointer
 
+    void releaseSlot(const int i); // put slot i on the unused chain
+    void trimSlots();   // give back unused slots at the end of the array
+    void compact();     // squeeze the holes out of the data area
+
+    // the presence bitmap of a fixed-width page
+    unsigned long long* present()
+      { return (unsigned long long*) data; }
+    const unsigned long long* present() const
+      { return (const unsigned long long*) data; }
+    const bool isPresent(const int i) const
+      { return (present()[i / 64] >> (i % 64)) & 1; }
+    int nextPresent(int i) const; // first record from slot number i
+
+    // insertRecord() and the rest for a fixed-width page
+    const Status insertFixed(const Record & rec, RID& rid);
+    const Status deleteFixed(const int i);
+    int deleteFixed(const SlotBitmap slots);
+    void trimFixed();
+
 public:
-    void init(const int pageNo); // initialize a new page
+    // initialize a new page, for records of recLen bytes each if
+    // recLen is not 0
+    void init(const int pageNo, const int recLen = 0);
     void dumpPage() const;       // dump contents of a page
 
     const Status getNextPage(int& pageNo) const; // returns value of nextPage
     const Status setNextPage(const int pageNo); // sets value of nextPage to pageNo
-    const short getFreeSpace() const; // returns amount of free space
+    const pageoff_t getFreeSpace() const; // returns amount of free space
 
     // inserts a new record (rec) into the page, returns RID of record 
     const Status insertRecord(const Record & rec, RID& rid);
@@ -59,6 +115,10 @@ public:
     // delete the record with the specified rid
     const Status deleteRecord(const RID & rid);
 
+    // delete the records of the slots set in slots, compacting the
+    // page once; returns the number of records deleted
+    int deleteRecords(const SlotBitmap slots);
+
     // returns RID of first record on page
     // returns  NORECORDS if page contains no records.  Otherwise, returns OK
     const Status firstRecord(RID& firstRid) const;
@@ -69,6 +129,27 @@ public:
 
     // returns reference to record with RID rid
     const Status getRecord(const RID & rid, Record & rec);
+
+    // the slots and the data area, for code that goes over all the
+    // records of the page at once (see filterPage()): slot i, from 0
+    // up to getSlotCnt(), is getSlots()[-i]
+    const slot_t* getSlots() const { return slot; }
+    const int getSlotCnt() const { return -slotCnt; }
+    const char* getData() const { return data; }
+
+    // the same for a fixed-width page: the length of its records (0 if
+    // the page has slots), the records present, and where record i
+    // starts in getData()
+    const int getRecLen() const
+      { return slot[0].length == FIXEDSLOT ? slot[0].offset : 0; }
+    const unsigned long long* getPresent() const { return present(); }
+    const int getRecOffset(const int i) const
+      { return freePtr + i * slot[0].offset; }
+
+    // the number of records of recLen bytes a fixed-width page holds
+    static int fixedCapacity(const int recLen);
 };
 
+static_assert(sizeof(Page) == PAGESIZE, "Page must fill exactly one page");
+
 #endif
@@ -0,0 +1,153 @@
+#ifndef PAGEIO_H
+#define PAGEIO_H
+
+#include <sys/uio.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "db.h"
+
+// ways of carrying out a batch of page reads and writes
+enum IOEngine { SYNCIO, THREADIO, URINGIO };
+
+// map an engine name ("sync", "threads", "uring") to an engine;
+// returns false if the name is not recognized
+bool getIOEngine(const char* name, IOEngine& engine);
+
+// returns the printable name of an engine
+const char* ioEngineName(const IOEngine engine);
+
+const int IODEPTH = 64;       // requests an engine keeps in flight at most
+const int IOWORKERS = 4;      // threads of the thread pool engine
+
+
+// a read or write of count adjacent pages of a file, starting at
+// pageNo; pages[i] holds page pageNo + i.  status is set when the
+// request is done.
+struct PageIOReq
+{
+  File*	file;
+  int	pageNo;
+  int	count;
+  bool	write;
+  Page*	pages[MAXIOPAGES];
+  Status status;
+};
+
+
+// An engine for batches of page I/O.  The buffer manager hands it the
+// reads of read-ahead and the writes of the background writer and of
+// flushFile() a batch at a time, so that many of them are in flight
+// at once; a single page it needs right away is read by File itself.
+//
+// io_uring submits a batch with one system call and reaps the
+// completions with another.  Where it is not available (old kernels,
+// seccomp) the thread pool engine has its threads do the requests
+// with ordinary positional I/O.  The synchronous engine does them one
+// after the other, as File would.
+
+class PageIO
+{
+protected:
+  // carry out req synchronously, through File
+  static void transfer(PageIOReq & req);
+  // the descriptor req goes to, pinned in fdCache until releaseFd(),
+  // or -1 if req must go through transfer() (pages not aligned for a
+  // file opened O_DIRECT, a compressed file)
+  static int fdFor(const PageIOReq & req);
+  static void releaseFd(const PageIOReq & req);
+  // count a request that took micros in the file's statistics
+  static void account(const PageIOReq & req, const long micros);
+
+public:
+  // the engine asked for, or the thread pool if it is io_uring and
+  // that cannot be set up
+  static PageIO* create(const IOEngine engine, const int depth = IODEPTH);
+  virtual ~PageIO() {}
+
+  virtual IOEngine engine() const = 0;
+
+  // carry out all of reqs and return when they are done.  Several
+  // threads may run batches at once.
+  virtual void run(vector<PageIOReq> & reqs) = 0;
+};
+
+// engine used by the buffer pools; synchronous unless minirel's -io
+// switch says otherwise
+extern PageIO* pageIO;
+
+
+class SyncPageIO : public PageIO
+{
+public:
+  IOEngine engine() const { return SYNCIO; }
+  void run(vector<PageIOReq> & reqs);
+};
+
+
+class ThreadPageIO : public PageIO
+{
+private:
+  // a request queued by run(), and how many of its batch are left
+  struct Job
+  {
+    PageIOReq* req;
+    int*       left;
+  };
+
+  vector<thread> workers;
+  deque<Job>	queue;
+  mutex		latch;		// protects queue, the left counts and stopping
+  condition_variable work;	// a request was queued, or shutdown
+  condition_variable done;	// a request was finished
+  bool		stopping;
+
+  void serve();			// body of the worker threads
+
+public:
+  ThreadPageIO(const int threads);
+  ~ThreadPageIO();
+
+  IOEngine engine() const { return THREADIO; }
+  void run(vector<PageIOReq> & reqs);
+};
+
+
+class UringPageIO : public PageIO
+{
+private:
+  int		ringFd;		// io_uring instance, -1 if setup failed
+  int		depth;		// entries of the submission queue
+  void*		sqRing;		// mapped submission and completion rings
+  size_t	sqRingSize;
+  void*		cqRing;
+  size_t	cqRingSize;
+  void*		sqes;		// mapped submission queue entries
+  size_t	sqesSize;
+  unsigned*	sqHead;
+  unsigned*	sqTail;
+  unsigned*	sqMask;
+  unsigned*	sqArray;
+  unsigned*	cqHead;
+  unsigned*	cqTail;
+  unsigned*	cqMask;
+  void*		cqes;
+  mutex		latch;		// one batch uses the rings at a time
+
+  // queue req as a submission queue entry, tagged with tag; iov must
+  // stay put until the request completes
+  void prepare(PageIOReq & req, const int fd, struct iovec* iov,
+               const unsigned long tag);
+
+public:
+  UringPageIO(const int entries);
+  ~UringPageIO();
+
+  bool ready() const { return ringFd >= 0; }
+  IOEngine engine() const { return URINGIO; }
+  void run(vector<PageIOReq> & reqs);
+};
+
+#endif
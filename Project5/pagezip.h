@@ -0,0 +1,27 @@
+#ifndef PAGEZIP_H
+#define PAGEZIP_H
+
+#include "page.h"
+
+// A small LZ77 codec for pages, in the manner of LZ4: the compressed
+// form is a run of sequences, each a token byte (literal count in the
+// high four bits, match length less 4 in the low four, 15 meaning
+// more follows in bytes of 255 and a last byte below 255), the
+// literals, and a two-byte offset back into what was decompressed so
+// far for the match.  The last sequence has literals only.  Cheap
+// enough to run on every page read and write of a compressed file
+// (see File).
+
+// bits of the hash of four bytes that finds earlier matches
+const int ZIPHASHBITS = 12;
+
+// compress page into out, which must have room for PAGESIZE bytes;
+// returns the compressed length, or 0 if the page does not get
+// smaller
+int zipPage(const Page* page, char* out);
+
+// decompress the length bytes at in into page; BADZIPPAGE if they are
+// not a compressed page
+const Status unzipPage(const char* in, const int length, Page* page);
+
+#endif
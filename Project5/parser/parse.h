@@ -57,6 +57,7 @@ typedef enum {
     N_LOAD,
     N_PRINT,
     N_HELP,
+    N_BUFFERS,
     N_SELECT,
     N_JOIN,
     N_PRIMATTR,
@@ -65,7 +66,9 @@ typedef enum {
     N_ATTRTYPE,
     N_VALUE,
     N_LIST,
-    N_ALIAS
+    N_ALIAS,
+    N_AND,
+    N_OR
 } NODEKIND;
 
 
@@ -137,6 +140,12 @@ typedef struct node {
 	    char *relname;
 	} HELP;
 
+	// buffers node */
+	struct {
+	    int nbufs;		// new number of frames, 0 if not given
+	    char *budget;	// new size as a memory budget, or NULL
+	} BUFFERS;
+
 	// select node */
 	struct {
 	    struct node *selattr;
@@ -144,6 +153,12 @@ typedef struct node {
 	    struct node *value;
 	} SELECT;
 
+	// and/or node: a condition of two selections or conditions */
+	struct {
+	    struct node *left;
+	    struct node *right;
+	} LOGIC;
+
 	// join node */
 	struct {
 	    struct node *joinattr1;
@@ -223,8 +238,10 @@ NODE *drop_node(char *relname, char *attrname);
 NODE *load_node(char *relname, char *filename);
 NODE *print_node(char *relname);
 NODE *help_node(char *relname);
+NODE *buffers_node(int nbufs, char *budget);
 NODE *select_node(NODE *selattr, int op, NODE *value);
 NODE *join_node(NODE *joinattr1, int op, NODE *joinattr2);
+NODE *logic_node(int kind, NODE *left, NODE *right);
 NODE *qualattr_node(char *relname, char *attrname);
 NODE *primattr_node(char *attrname, int nbuckets);
 NODE *attrval_node(char *attrname, NODE *value);
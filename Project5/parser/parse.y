@@ -5,6 +5,7 @@
 
 #include <stdlib.h>
 #include "heapfile.h"
+#include "wal.h"
 #include "parse.h"
 #include "stdio.h"
 
@@ -72,6 +73,8 @@ static NODE *parse_tree;                // root of parse tree
 		T_QSTRING
 		T_SHELL_CMD
 
+%token		RW_BUFFERS
+
 %type	<ival>	op
 
 %type	<sval>	opt_into_relname
@@ -92,10 +95,14 @@ static NODE *parse_tree;                // root of parse tree
 		load
 		print
 		help
+		buffers
 		quit
 		opt_primary_attr
 		opt_where
 		qual
+		condition
+		conjunction
+		factor
 		selection
 		join
 		non_mt_qualattr_list
@@ -155,6 +162,7 @@ command
 	| load
 	| print
 	| help
+	| buffers
 	| quit
 	| nothing
 	{
@@ -316,6 +324,21 @@ help
 	}
 	;
 
+buffers
+	: RW_BUFFERS
+	{
+		$$ = buffers_node(0, NULL);
+	}
+	| RW_BUFFERS T_INT
+	{
+		$$ = buffers_node($2, NULL);
+	}
+	| RW_BUFFERS T_QSTRING
+	{
+		$$ = buffers_node(0, $2);
+	}
+	;
+
 quit
 	: RW_QUIT ';'
 	{
@@ -368,10 +391,35 @@ opt_where
 	;
 
 qual
-	: selection
+	: condition
 	| join
 	;
 
+/* and binds tighter than or */
+condition
+	: condition RW_OR conjunction
+	{
+		$$ = logic_node(N_OR, $1, $3);
+	}
+	| conjunction
+	;
+
+conjunction
+	: conjunction RW_AND factor
+	{
+		$$ = logic_node(N_AND, $1, $3);
+	}
+	| factor
+	;
+
+factor
+	: selection
+	| '(' condition ')'
+	{
+		$$ = $2;
+	}
+	;
+
 selection
 	: qualattr op value
 	{
@@ -529,9 +577,18 @@ void parse(void)
     printf("%s", PROMPT);
     fflush(stdout);
 
-    // if a query was successfully read, interpret it
-    if(yyparse() == 0 && parse_tree != NULL)
+    // if a query was successfully read, interpret it; what it changed
+    // is durable once its log records are synced (shared with others
+    // committing at the same time)
+    if(yyparse() == 0 && parse_tree != NULL) {
       interp(parse_tree);
+
+      Status status;
+      if (wal && (status = wal->commit()) != OK) {
+        Error error;
+        error.print(status);
+      }
+    }
   }
 }
 
@@ -78,7 +78,8 @@
      T_REAL = 294,
      T_STRING = 295,
      T_QSTRING = 296,
-     T_SHELL_CMD = 297
+     T_SHELL_CMD = 297,
+     RW_BUFFERS = 298
    };
 #endif
 /* Tokens.  */
@@ -122,6 +123,7 @@
 #define T_STRING 295
 #define T_QSTRING 296
 #define T_SHELL_CMD 297
+#define RW_BUFFERS 298
 
 
 
@@ -5,6 +5,21 @@
 
 enum JoinType {NLJoin, SMJoin, HashJoin};
 
+//
+// A WHERE clause of selections on one relation: attr op value, with
+// the value in text form in attr.attrValue and its type in
+// attr.attrType, or the AND (FILTERAND) or OR (FILTEROR) of two others
+//
+
+struct Condition
+{
+  FilterKind kind;
+  attrInfo attr;                        // of a FILTERTERM
+  Operator op;
+  const Condition *left;                // of a FILTERAND or FILTEROR
+  const Condition *right;
+};
+
 //
 // Prototypes for query layer functions
 //
@@ -17,6 +32,11 @@ const Status QU_Select(const string & result,
 		       const Operator op, 
 		       const char *attrValue);
 
+const Status QU_Select(const string & result, 
+		       const int projCnt, 
+		       const attrInfo projNames[],
+		       const Condition *where);
+
 const Status QU_Join(const string & result, 
 		     const int projCnt, 
 		     const attrInfo projNames[],
@@ -34,4 +54,11 @@ const Status QU_Delete(const string & relation,
 		       const Datatype type, 
 		       const char *attrValue);
 
+const Status QU_Delete(const string & relation, 
+		       const Condition *where);
+
+// the scan filter of where (see filter.h), with the attributes looked
+// up in the catalog and the values converted to their types
+const Status QU_Filter(const Condition *where, ScanFilter & filter);
+
 #endif
@@ -1,6 +1,7 @@
 #ifndef SORT_H
 #define SORT_H
 
+#include <memory>
 #include "heapfile.h"
 
 // define if debug output wanted
@@ -38,8 +39,8 @@ class SortedFile {
 
   typedef struct {
     string name;                        // name of run file
-    HeapFileScan* inFile;               // ptr to input file
-    InsertFileScan* outFile;		// ptr to output file
+    unique_ptr<HeapFileScan> inFile;    // input file
+    unique_ptr<InsertFileScan> outFile; // output file
     int valid;                          // TRUE if recPtr has a record
     Record rec;
     RID rid;                            // RID of current record of run
@@ -48,8 +49,10 @@ class SortedFile {
 
   vector<RUN> runs;                   // holds info about each sub-run
 
-  HeapFile* hfile;                   // source file to sort
-  HeapFileScan* hfs;                   // source file to sort
+  // the scans own their files and page pins, so that an error
+  // anywhere still unpins and closes everything
+  unique_ptr<HeapFile> hfile;           // source file to sort
+  unique_ptr<HeapFileScan> hfs;         // source file to sort
   string fileName;                      // name of source file to sort
   Datatype type;                        // type of sort attribute
   int offset;                           // offset of sort attribute
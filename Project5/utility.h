@@ -27,6 +27,12 @@ const Status UT_Load(const string & relation,
 
 const Status UT_Print(string relation);
 
+// true if relation is a (read-only) system relation
+bool UT_IsSysRel(const string & relation);
+
+// rebuild system relation relation from the current statistics
+const Status UT_RefreshSysRel(const string & relation);
+
 void   UT_Quit(void);
 
 #endif
@@ -0,0 +1,170 @@
+#ifndef WAL_H
+#define WAL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include "db.h"
+
+class Page;
+
+// name of the log, in the database directory
+const char* const WALNAME = "wal.log";
+
+// a leader of a group commit waits this long for other threads that
+// are committing to add their records before it syncs the log, if
+// there are any (see WAL::setCommitDelay())
+const int WALCOMMITDELAY = 0;   // microseconds
+
+// log records are written out, without a sync, once this many bytes
+// have gathered in memory
+const int WALBUFBYTES = 1 << 20;
+
+// the log moves on to a new file at the first checkpoint after its
+// file has grown past this (see WAL::startFile() and
+// WAL::setFileBytes())
+const long long WALFILEBYTES = 64 << 20;
+
+struct WALStats
+{
+  atomic<long long> records;   // records logged
+  atomic<long long> bytes;     // bytes logged
+  atomic<long long> images;    // records holding a whole page
+  atomic<long long> commits;   // calls of commit()
+  atomic<long long> syncs;     // fdatasync() calls on the log
+
+  WALStats()
+    {
+      records = bytes = images = commits = syncs = 0;
+    }
+};
+
+
+// The write-ahead log.  Every change to a page of a logged file (all
+// files except the temporary ones, see File::isLogged()) is logged by
+// the buffer manager before the page can be written back: the bytes
+// of the page that changed, or the whole page the first time the page
+// changes after it was read in.  File logs the header page it keeps
+// in memory the same way, and the creation and destruction of files.
+// A page is written back to its file only after the log has been
+// synced up to the last change to the page.
+//
+// commit() makes everything logged so far durable.  Threads that
+// commit while the log is being synced wait for the sync after it and
+// share it (group commit), so many commits cost one fdatasync().
+//
+// Recovery is by redo only: recover() applies the records of the log
+// to the files in order and then empties the log.  Since every page
+// changed since the log was last emptied starts with a whole image of
+// the page, torn pages are repaired as well.  The log is emptied by
+// checkpoint() when nothing is left in the buffer pools.
+//
+// While the pools are in use the log is kept short in two steps, by
+// the buffer manager's checkpoints.  startFile() renames the log file
+// to the previous file and goes on in a new one, in which every page
+// starts over with a whole image and every file's header is logged
+// again; dropPrevious() removes the previous file at a later
+// checkpoint, once every page changed in it is written out or logged
+// whole in the new file.  Recovery reads the previous file, if there
+// is one, before the log file.
+
+class WAL
+{
+public:
+  // start an empty log in file path.  recover() must have been run on
+  // a log left over from an earlier session first.
+  WAL(const string & path, Status & status);
+  ~WAL();
+
+  // log the change of page pageNo of file fileName from before to
+  // after; before is NULL to log the whole page.  imaged, if not
+  // NULL, is the log file (see startFile()) the whole page was last
+  // logged in, 0 if none: the whole page is logged if that is not
+  // this file, and imaged is updated.  Returns the record's LSN, 0 if
+  // nothing changed.
+  LSN logPage(const string & fileName, const int pageNo,
+              const Page* before, const Page* after, int* imaged = NULL);
+  // log the header page of file fileName (creating the file on
+  // recovery if it is not there)
+  LSN logFileHeader(const string & fileName, const DBPage & header);
+  // log the destruction of file fileName
+  LSN logDestroy(const string & fileName);
+
+  // return once the log is on disk up to and including lsn
+  const Status flush(const LSN lsn);
+  // return once everything logged so far is on disk
+  const Status commit();
+
+  // empty the log.  The changes it holds must all be in their files
+  // (which are synced first, after the page maps of compressed files
+  // are written back, see File::flushZipped()).
+  const Status checkpoint();
+
+  // move on to a new log file if the current one has grown past
+  // WALFILEBYTES and there is no previous file
+  const Status startFile();
+  // LSN of the last record in the previous log file, 0 if there is
+  // none
+  LSN previousEnd();
+  // remove the previous log file if it still ends at end.  The
+  // changes it holds must all be in their files (which are synced
+  // first, as for checkpoint()).
+  const Status dropPrevious(const LSN end);
+
+  // apply the log in file path to the files it names and empty it;
+  // applied is the number of records redone.  OK if there is no log.
+  static const Status recover(const string & path, int & applied);
+
+  void setCommitDelay(const int micros)
+    {
+      commitDelay = micros;
+    }
+  void setFileBytes(const long long bytes)
+    {
+      fileLimit = bytes;
+    }
+  const WALStats & getStats() const
+    {
+      return walStats;
+    }
+  void printStats() const;
+
+private:
+  // append a record with payload to the log buffer; returns its LSN,
+  // or 0 if inFile is not 0 and the log has moved on from file inFile
+  LSN append(const int type, const string & fileName, const int pageNo,
+             const char* payload, const int length, const int inFile = 0);
+  // append without the latch
+  LSN intappend(const int type, const string & fileName, const int pageNo,
+                const char* payload, const int length);
+  // write out the log buffer, and sync the log if sync; called with
+  // latch held in guard, which is dropped meanwhile
+  const Status writeOut(unique_lock<mutex> & guard, const bool sync);
+
+  string	path;
+  int		fd;		// the log, opened for appending
+  mutex		latch;		// protects the fields below
+  condition_variable written;	// a write of the log buffer finished
+  string	buffer;		// records not written out yet
+  LSN		lastLSN;	// LSN of the last record logged
+  LSN		writtenLSN;	// last LSN written out
+  LSN		syncedLSN;	// last LSN on disk
+  atomic<int>	fileNo;		// the log file, counted from 1
+  long long	fileBytes;	// bytes logged in the log file
+  LSN		prevLSN;	// last LSN of the previous file, 0 if none
+  map<string, string> headers;	// last header logged of each file
+  bool		writing;	// a thread is writing out the buffer
+  bool		failed;		// a write or sync failed: log unusable
+  int		committers;	// threads in commit()
+  atomic<int>	commitDelay;
+  atomic<long long> fileLimit;	// see WALFILEBYTES
+  WALStats	walStats;
+};
+
+// the log of this session, NULL if changes are not logged (minirel's
+// -w switch turns logging on)
+extern WAL* wal;
+
+#endif